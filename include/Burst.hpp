@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace Burst
+{
+    struct Params
+    {
+        int tile_size = 16;       // 對齊 tile 大小 (半解析度灰階像素，CFA 上為兩倍)，需為偶數
+        int pyramid_levels = 4;   // 高斯金字塔層數 (第 0 層即半解析度灰階)
+        int search_radius = 4;    // 最粗層的搜尋半徑
+        int refine_radius = 1;    // 其餘各層的搜尋半徑
+        float noise_sigma = 0.02f; // tile 平均差異低於此值視為雜訊，權重接近 1
+    };
+
+    // 多張 RAW 合成：以第一張為參考，其餘逐張對齊後累加，不需同時保留所有影格
+    class Merger
+    {
+    public:
+        Merger(const cv::Mat& reference_raw, const Params& params = Params());
+
+        // 對齊並累加一張影格 (CV_32FC1 正規化 CFA，尺寸需與參考相同)
+        bool Add(const cv::Mat& alternate_raw);
+
+        // 合成後的 CFA，可直接送入既有的解馬賽克 / 白平衡 / CCM / Gamma 流程
+        cv::Mat Result() const;
+
+        int FrameCount() const { return frames_; }
+
+    private:
+        void Accumulate(const cv::Mat& raw, const std::vector<cv::Point>& offsets, const std::vector<float>& weights);
+
+        Params params_;
+        cv::Size size_;
+        std::vector<cv::Mat> ref_pyramid_;
+        cv::Mat sum_;
+        cv::Mat weight_;
+        std::vector<float> window_;
+        int tiles_x_ = 0;
+        int tiles_y_ = 0;
+        int frames_ = 0;
+    };
+
+    // 2x2 Bayer quad 平均成半解析度灰階，並往下建立高斯金字塔
+    std::vector<cv::Mat> BuildPyramid(const cv::Mat& raw, int levels);
+}
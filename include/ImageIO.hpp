@@ -3,14 +3,17 @@
 #include <string>
 #include <opencv2/opencv.hpp>
 #include <libraw/libraw.h>
+#include "Statistics.hpp"
 
 namespace ImageIO
 {
     cv::Mat ReadRaw16(const std::string& filepath, int width, int height);
 
-    cv::Mat ReadDNG(LibRaw& processor);
+    // collector 不為 nullptr 時，於正規化的同一個迴圈中累積統計
+    cv::Mat ReadDNG(LibRaw& processor, Statistics::Collector* collector = nullptr);
 
     void ShowImage(const std::string& winName, const cv::Mat& img);
 
-    void SaveImage(const std::string& filepath, const cv::Mat& img);
+    // 寫檔失敗時回傳 false
+    bool SaveImage(const std::string& filepath, const cv::Mat& img);
 }
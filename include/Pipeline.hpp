@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <libraw/libraw.h>
+#include "Statistics.hpp"
+
+namespace Pipeline
+{
+    // 一次處理工作所需的參數
+    struct Job
+    {
+        std::string id;
+        std::string input_path;
+        std::string output_path;
+        std::string pattern;      // 空字串代表從 DNG metadata 取得
+        double gamma_value = 2.2;
+        std::string stats_path;   // 空字串代表不輸出統計 JSON
+        int stats_step = 1;
+        std::vector<std::string> burst_paths; // 連拍的其餘影格，與 input_path (參考影格) 合成
+    };
+
+    // 各階段耗時 (毫秒)
+    struct Timing
+    {
+        double decode_ms = 0.0;   // open_file + unpack
+        double ingest_ms = 0.0;   // RAW 正規化 + 統計
+        double merge_ms = 0.0;    // 連拍對齊 + 合成
+        double demosaic_ms = 0.0; // 通道分配 + 解馬賽克
+        double color_ms = 0.0;    // 白平衡 + CCM
+        double gamma_ms = 0.0;
+        double save_ms = 0.0;
+        double total_ms = 0.0;
+    };
+
+    // 單張處理的結果，給 CLI 顯示與列印用
+    struct Output
+    {
+        cv::Mat image;               // 8 位元 BGR 輸出
+        Statistics::ImageStats stats; // 參考影格的 RAW 統計
+        std::string pattern;
+    };
+
+    // 常駐的處理單元：LibRaw 實例、Bayer 遮罩與 Gamma 查表在工作之間保留重用
+    class Worker
+    {
+    public:
+        // interactive 給 CLI 用：顯示初始 BGR 通道預覽，Gamma 逐像素以 cv::pow 計算 (與原本 CLI 輸出一致)；
+        // 常駐模式維持預設，不開視窗並使用 Gamma 查表
+        explicit Worker(bool interactive = false) : interactive_(interactive) {}
+        Worker(const Worker&) = delete;
+        Worker& operator=(const Worker&) = delete;
+
+        // output 不為 nullptr 時一併回傳輸出影像與 RAW 統計
+        bool Run(const Job& job, Timing& timing, std::string& error, Output* output = nullptr);
+
+        // 從正規化後的 CFA 影像跑到 8 位元輸出 (解馬賽克 / 白平衡 / CCM / Gamma)
+        cv::Mat Develop(const cv::Mat& raw, const std::string& pattern, const float cam_mul[4],
+                        const cv::Mat& ccm, double gamma, Timing& timing);
+
+    private:
+        static bool Decode(LibRaw& processor, const std::string& path, std::string& error);
+        static bool LoadFrame(LibRaw& processor, const std::string& path, cv::Mat& frame, std::string& error);
+        void PrepareMasks(int height, int width, const std::string& pattern);
+        const std::vector<float>& GammaLUT(double gamma);
+
+        bool interactive_;
+        LibRaw processor_;
+        LibRaw prefetch_processor_; // 連拍時在背景解碼下一張影格
+
+        cv::Mat maskR_, maskG_, maskB_;
+        std::string mask_pattern_;
+
+        std::vector<float> gamma_lut_;
+        double lut_gamma_ = 0.0;
+    };
+
+    std::string TimingToJson(const Timing& timing);
+}
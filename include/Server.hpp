@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include "Pipeline.hpp"
+
+namespace Server
+{
+    // 常駐模式：socket_path 為 UNIX domain socket 路徑，"-" 代表使用 stdin/stdout
+    // 每行一個工作 (key=value 以空白分隔)，每個工作回傳一行 JSON
+    int Run(const std::string& socket_path, int num_workers);
+
+    // 解析一行工作描述，例如：id=1 input=a.dng output=a.png gamma=2.2 stats=a.json stats_step=4
+    // 連拍合成時以逗號列出其餘影格：burst=b.dng,c.dng
+    bool ParseJob(const std::string& line, Pipeline::Job& job, std::string& error);
+}
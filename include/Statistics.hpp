@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+namespace Statistics
+{
+    // 單一顏色通道 (CFA 上的 R / G / B) 統計
+    struct ChannelStats
+    {
+        std::vector<uint32_t> histogram;
+        uint64_t count = 0;
+        uint64_t clipped_high = 0; // >= 1.0 (白點飽和)
+        uint64_t clipped_low = 0;  // <= black_level (黑位)
+        float black_level = 0.0f;  // 正規化後的黑位 (RAW 未扣除黑位)
+        double sum = 0.0;
+        float min = 1.0f;
+        float max = 0.0f;
+
+        double Mean() const { return count ? sum / count : 0.0; }
+    };
+
+    // 整張 RAW 影像的統計結果，供 AE / AF 與曝光 QA 使用
+    struct ImageStats
+    {
+        std::string source;
+        std::string pattern;
+        int width = 0;
+        int height = 0;
+        int step = 1;              // 取樣間隔 (以 2x2 Bayer quad 為單位)
+        ChannelStats channels[3];  // 0 = R, 1 = G, 2 = B
+        double sharpness = 0.0;    // 同色相鄰像素梯度平方平均 (Tenengrad)
+        uint64_t sharpness_samples = 0;
+
+        float Min() const;
+        float Max() const;
+        double MeanLuma() const;   // AE 用的平均亮度 (Rec.601 權重)
+    };
+
+    // 在讀取 RAW CFA 的同一個迴圈中累積統計，避免額外整張影像掃描
+    class Collector
+    {
+    public:
+        Collector(const std::string& pattern, int step = 1, int bins = 256);
+
+        // 相同設定但尚未累積任何資料的 Collector (平行讀取時每個區段一份)
+        Collector EmptyCopy() const;
+
+        // 設定某通道 (0 = R, 1 = G, 2 = B) 正規化後的黑位，clipped_low 以此為門檻
+        void SetBlackLevel(int channel, float level) { stats_.channels[channel].black_level = level; }
+
+        bool IsSampledRow(int row) const { return ((row >> 1) % step_) == 0; }
+
+        // row 為剛寫入的正規化列資料；row_above 為同色的上方列 (row - 2)，沒有時傳 nullptr
+        void AccumulateRow(int row, const float* data, const float* row_above, int width);
+
+        // 合併另一個 Collector (例如平行讀取時每個區段各自累積)
+        void Merge(const Collector& other);
+
+        ImageStats Finish(int width, int height) const;
+
+    private:
+        int ChannelAt(int row, int col) const { return channel_of_[((row & 1) << 1) | (col & 1)]; }
+
+        int step_;
+        int bins_;
+        int channel_of_[4];
+        ImageStats stats_;
+    };
+
+    // 對已存在的單通道 CFA 影像計算統計 (模擬資料等沒有經過 ReadDNG 的情況)
+    ImageStats Compute(const cv::Mat& raw, const std::string& pattern, int step = 1);
+
+    std::string ToJson(const ImageStats& stats);
+    bool SaveJson(const std::string& filepath, const ImageStats& stats);
+}
@@ -24,4 +24,11 @@ namespace Utils
 
     // Gamma 校正
     cv::Mat ApplyGammaCorrection(const cv::Mat& input_bgr, double gamma);
+
+    // 預先計算的 Gamma 查表 (常駐模式下重複使用)
+    std::vector<float> BuildGammaLUT(double gamma, int size = 65536);
+    cv::Mat ApplyGammaLUT(const cv::Mat& input_bgr, const std::vector<float>& lut);
+
+    // JSON 字串跳脫
+    std::string EscapeJson(const std::string& text);
 }
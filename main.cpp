@@ -1,6 +1,9 @@
 #include "Utils.hpp"
 #include "ImageIO.hpp"
-#include "Demosaic.hpp"
+#include "Statistics.hpp"
+#include "Server.hpp"
+#include "Pipeline.hpp"
+#include <algorithm>
 #include <iostream>
 #include <libraw/libraw.h>
 
@@ -14,13 +17,13 @@ int main(int argc, char** argv)
     std::string pattern;
     double gamma_value;
     bool simulatedMode;
+    std::string stats_path;
+    int stats_step;
 
-    LibRaw processor; // LibRaw 處理器實例
-
-    cv::Mat raw;
-    cv::Mat ccm_mat(3, 3, CV_32F);
-    int width = 0, height = 0;
-    float cam_mul_coeffs[4] = {1.0f, 1.0f, 1.0f, 1.0f}; 
+    Pipeline::Worker worker(true);  // 與常駐模式共用同一套處理流程，另外顯示預覽並逐像素計算 Gamma
+    Pipeline::Timing timing;
+    Pipeline::Output output;
+    std::string error;
     
     // ===============================================================
 
@@ -28,32 +31,58 @@ int main(int argc, char** argv)
     // ===============================================================
         if (argc < 2)
         {
-            std::cerr << "Usage: ./mini_isp <input.dng> [output.png] [bayer.pattern] [gamma.value] [simulatedMode(assume 0 == False)]" << std::endl;
+            std::cerr << "Usage: ./mini_isp <input.dng> [output.png] [bayer.pattern] [gamma.value] [simulatedMode(assume 0 == False)] [stats.json] [stats.step]" << std::endl;
             return -1;
         }
+        // 常駐模式：./mini_isp --serve <socket.path | -> [workers]
+        if (std::string(argv[1]) == "--serve")
+        {
+            if (argc < 3)
+            {
+                std::cerr << "Usage: ./mini_isp --serve <socket.path | -> [workers]" << std::endl;
+                return -1;
+            }
+            return Server::Run(argv[2], (argc >= 4) ? std::atoi(argv[3]) : 0);
+        }
+
+        // 連拍合成：./mini_isp --burst <output.png> <reference.dng> <frame.dng> [frame.dng ...]
+        if (std::string(argv[1]) == "--burst")
+        {
+            if (argc < 5)
+            {
+                std::cerr << "Usage: ./mini_isp --burst <output.png> <reference.dng> <frame.dng> [frame.dng ...]" << std::endl;
+                return -1;
+            }
+            Pipeline::Job job;
+            job.output_path = argv[2];
+            job.input_path = argv[3];
+            job.burst_paths.assign(argv + 4, argv + argc);
+
+            Pipeline::Worker burst_worker; // 連拍只輸出合成結果，不開預覽視窗
+            if (!burst_worker.Run(job, timing, error))
+            {
+                std::cerr << "Error: " << error << std::endl;
+                return -1;
+            }
+            std::cout << "Merged " << job.burst_paths.size() + 1 << " frames into: " << job.output_path << std::endl;
+            std::cout << "Timing (ms): " << Pipeline::TimingToJson(timing) << std::endl;
+            return 0;
+        }
+
         input_path = argv[1];
         output_path = (argc >= 3) ? argv[2] : "../data/output.png";
         pattern = (argc >= 4) ? argv[3] : "";
         gamma_value = (argc >= 5) ? (std::stod(argv[4])) : 2.2;
         simulatedMode = (argc >= 6) ? (std::atoi(argv[5]) != 0)  : false;
-        
-        if (processor.open_file(input_path.c_str()) != LIBRAW_SUCCESS)
-        {
-            std::cerr << "Failed to open DNG file: " << input_path << std::endl;
-            return -1;
-        }
-        if (processor.unpack() != LIBRAW_SUCCESS)
-        {
-            std::cerr << "Failed to unpack DNG file: " << input_path << std::endl;
-            return -1;
-        }
+        stats_path = (argc >= 7) ? argv[6] : "";
+        stats_step = (argc >= 8) ? std::max(std::atoi(argv[7]), 1) : 1;
     // ===============================================================
     if (simulatedMode)
     {
-        width = 4;
-        height = 4;
+        int width = 4;
+        int height = 4;
         
-        raw = cv::Mat(height, width, CV_32FC1);
+        cv::Mat raw(height, width, CV_32FC1);
         for (int i = 0; i < height; ++i)
         {
             for (int j = 0; j < width; ++j)
@@ -65,118 +94,61 @@ int main(int argc, char** argv)
             }
         }
         ImageIO::ShowImage("Raw Simulated Data", raw);
-        ccm_mat = cv::Mat::eye(3, 3, CV_32F); 
-        cam_mul_coeffs[0] = 1.0f;
-        cam_mul_coeffs[1] = 1.0f;
-        cam_mul_coeffs[2] = 1.0f;
-        cam_mul_coeffs[3] = 1.0f;
-    }
-    else
-    {
-
+        if (pattern.empty())
+            pattern = "RGGB";
 
-        raw = ImageIO::ReadDNG(processor);
-        
-        auto ccm = processor.imgdata.color.rgb_cam;
-        for (int i = 0; i < 3; ++i)
-        {
-            for (int j = 0; j < 3; ++j)
-            {
-                ccm_mat.at<float>(i, j) = ccm[i][j];
-            }
-        }
-        
-        width = processor.imgdata.sizes.raw_width;
-        height = processor.imgdata.sizes.raw_height;
+        const float cam_mul_coeffs[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        output.pattern = pattern;
+        output.stats = Statistics::Compute(raw, pattern, stats_step);
+        output.stats.source = "simulated";
+        output.image = worker.Develop(raw, pattern, cam_mul_coeffs, cv::Mat::eye(3, 3, CV_32F), gamma_value, timing);
 
-        if (pattern.empty())
-            pattern = Utils::GetBayerPattern(processor);
-        else if(pattern == "UNKNOWN")
-        {
-            std::cerr << "Error: Failed to determine Bayer Pattern. Exiting." << std::endl;
+        if (!stats_path.empty() && !Statistics::SaveJson(stats_path, output.stats))
             return -1;
-        }
-        else if(pattern != "RGGB")
-        {
-            std::cerr << "Error: " << pattern << " pattern Unsupported now." << std::endl;
+        if (!output_path.empty() && !ImageIO::SaveImage(output_path, output.image))
             return -1;
-        }
-
-        for (int i = 0; i < 4; ++i) 
-        {
-            cam_mul_coeffs[i] = processor.imgdata.color.cam_mul[i];
-            if (cam_mul_coeffs[i] <= 0) cam_mul_coeffs[i] = 1.0f; 
-        }
-        gamma_value = 2.2; 
     }
-    
-    if (raw.empty())
+    else
     {
-        std::cerr << "Error: Raw image data is empty." << std::endl;
-        return -1;
+        Pipeline::Job job;
+        job.input_path = input_path;
+        job.output_path = output_path;
+        job.pattern = pattern;
+        job.gamma_value = 2.2; // DNG 模式維持原本固定 2.2 的行為
+        job.stats_path = stats_path;
+        job.stats_step = stats_step;
+
+        if (!worker.Run(job, timing, error, &output))
+        {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
     }
 
+    const Statistics::ImageStats& stats = output.stats;
+
     std::cout << "--- Processing Image ---" << std::endl;
     std::cout << (simulatedMode ? "Mode: Simulated Data Test" : "Mode: Real DNG File Processing") << std::endl;
-    std::cout << "Image Width: " << width << ", Height: " << height << std::endl;
-    std::cout << "Bayer Pattern used: " << pattern << std::endl;
-
-    double raw_min, raw_max;
-    cv::minMaxLoc(raw, &raw_min, &raw_max);
-    std::cout << "Raw image min: " << raw_min << ", max: " << raw_max << std::endl;
-    
+    std::cout << "Image Width: " << stats.width << ", Height: " << stats.height << std::endl;
+    std::cout << "Bayer Pattern used: " << output.pattern << std::endl;
 
-    cv::Mat maskR, maskG, maskB;
-    Utils::GenerateBayerMasks(height, width, maskR, maskG, maskB, pattern);
-
-    // Verify Mask 
-    // ===============================================================
-    // ImageIO::ShowImage("Mask R", maskR);
-    // ImageIO::ShowImage("Mask G", maskG);
-    // ImageIO::ShowImage("Mask B", maskB);
-    // ===============================================================
-    double r_min, r_max, g_min, g_max, b_min, b_max;
-    cv::minMaxLoc(maskR, &r_min, &r_max);
-    cv::minMaxLoc(maskG, &g_min, &g_max);
-    cv::minMaxLoc(maskB, &b_min, &b_max);
-    std::cout << "Mask R min/max: " << r_min << "/" << r_max << std::endl;
-    std::cout << "Mask G min/max: " << g_min << "/" << g_max << std::endl;
-    std::cout << "Mask B min/max: " << b_min << "/" << b_max << std::endl;
-    
-    auto init_bgr = Utils::AssignInitialChannels(raw, maskR, maskG, maskB);
-    cv::Mat init_bgr_display;
-    init_bgr.convertTo(init_bgr_display, CV_8UC3, 255.0);
-    ImageIO::ShowImage("Initial BGR Channels", init_bgr_display);
-
-    
-    double minVal, maxVal;
-    cv::minMaxLoc(init_bgr, &minVal, &maxVal);
-    std::cout << "Initial BGR min: " << minVal << ", max: " << maxVal << std::endl;
-
-    auto demosaiced = Demosaic::NearestNeighborInterpolation(init_bgr);
-    
-    cv::minMaxLoc(demosaiced, &minVal, &maxVal);
-    std::cout << "Demosaiced min: " << minVal << ", max: " << maxVal << std::endl;
-    
-    auto white_balanced = Utils::ApplyWhiteBalance(demosaiced, cam_mul_coeffs);
-    cv::minMaxLoc(white_balanced, &minVal, &maxVal);
-    std::cout << "White-Balanced min: " << minVal << ", max: " << maxVal << std::endl;
-
-    auto color_corrected = Utils::ApplyCCM(white_balanced, ccm_mat);
-    
-
-    auto gamma_corrected = Utils::ApplyGammaCorrection(color_corrected, gamma_value);
-    cv::minMaxLoc(gamma_corrected, &minVal, &maxVal);
-    std::cout << "Gamma-Corrected min: " << minVal << ", max: " << maxVal << std::endl;
-
-    cv::Mat image_display;
-    gamma_corrected.convertTo(image_display, CV_8UC3, 255.0);
-    
-    ImageIO::ShowImage("image_display", image_display); 
+    // stats.step > 1 時 min/max 只來自取樣到的 Bayer 區塊，不一定是整張影像的極值
+    if (stats.step > 1)
+        std::cout << "Raw image sampled min: " << stats.Min() << ", max: " << stats.Max()
+                  << " (every " << stats.step << " Bayer quads)" << std::endl;
+    else
+        std::cout << "Raw image min: " << stats.Min() << ", max: " << stats.Max() << std::endl;
+    std::cout << "Raw mean R/G/B: " << stats.channels[0].Mean() << "/" << stats.channels[1].Mean() << "/" << stats.channels[2].Mean()
+              << ", clipped: " << stats.channels[0].clipped_high + stats.channels[1].clipped_high + stats.channels[2].clipped_high
+              << ", sharpness: " << stats.sharpness << std::endl;
+    if (!stats_path.empty())
+        std::cout << "Saved image statistics to: " << stats_path << std::endl;
+    std::cout << "Timing (ms): " << Pipeline::TimingToJson(timing) << std::endl;
+
+    ImageIO::ShowImage("image_display", output.image); 
     
     if (!output_path.empty()) 
     {
-        ImageIO::SaveImage(output_path, image_display);
         std::cout << "Saved output image to: " << output_path << std::endl;
     } 
     else 
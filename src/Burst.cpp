@@ -0,0 +1,235 @@
+#include "Burst.hpp"
+#include <cmath>
+#include <limits>
+
+namespace Burst
+{
+    // 越界時夾回影像內，並維持與原座標相同的 Bayer 相位 (奇偶)
+    static inline int ClampSamePhase(int v, int n, int parity)
+    {
+        v = std::min(std::max(v, 0), n - 1);
+        if (((v ^ parity) & 1) && n > 1)
+            v += (v > 0) ? -1 : 1;
+        return v;
+    }
+
+    std::vector<cv::Mat> BuildPyramid(const cv::Mat& raw, int levels)
+    {
+        CV_Assert(raw.type() == CV_32FC1);
+
+        int h = raw.rows / 2, w = raw.cols / 2;
+        cv::Mat gray(h, w, CV_32FC1);
+        for (int i = 0; i < h; ++i)
+        {
+            const float* r0 = raw.ptr<float>(2 * i);
+            const float* r1 = raw.ptr<float>(2 * i + 1);
+            float* dst = gray.ptr<float>(i);
+            for (int j = 0; j < w; ++j)
+                dst[j] = 0.25f * (r0[2 * j] + r0[2 * j + 1] + r1[2 * j] + r1[2 * j + 1]);
+        }
+
+        std::vector<cv::Mat> pyramid;
+        pyramid.push_back(gray);
+        for (int l = 1; l < levels; ++l)
+        {
+            const cv::Mat& prev = pyramid.back();
+            if (prev.rows < 16 || prev.cols < 16)
+                break;
+            cv::Mat down;
+            cv::pyrDown(prev, down);
+            pyramid.push_back(down);
+        }
+        return pyramid;
+    }
+
+    // 在 rect 範圍內計算 ref 與位移後 alt 的平均絕對差；重疊不足一半時回傳無限大
+    static float TileDistance(const cv::Mat& ref, const cv::Mat& alt, const cv::Rect& rect, int dx, int dy)
+    {
+        double sum = 0.0;
+        int count = 0;
+        for (int y = rect.y; y < rect.y + rect.height; ++y)
+        {
+            int ay = y + dy;
+            if (ay < 0 || ay >= alt.rows)
+                continue;
+            const float* r = ref.ptr<float>(y);
+            const float* a = alt.ptr<float>(ay);
+            for (int x = rect.x; x < rect.x + rect.width; ++x)
+            {
+                int ax = x + dx;
+                if (ax < 0 || ax >= alt.cols)
+                    continue;
+                sum += std::fabs(r[x] - a[ax]);
+                count++;
+            }
+        }
+
+        if (count * 2 < rect.width * rect.height || count == 0)
+            return std::numeric_limits<float>::infinity();
+        return static_cast<float>(sum / count);
+    }
+
+    Merger::Merger(const cv::Mat& reference_raw, const Params& params)
+        : params_(params), size_(reference_raw.size())
+    {
+        CV_Assert(reference_raw.type() == CV_32FC1);
+
+        // tile 起點必須落在偶數 CFA 座標上才能保持 Bayer 相位
+        params_.tile_size = std::max(2, params_.tile_size & ~1);
+
+        ref_pyramid_ = BuildPyramid(reference_raw, params_.pyramid_levels);
+
+        // tile 在 CFA 上為 2 * tile_size，以半個 tile 的間距重疊
+        const int stride = params_.tile_size;
+        const int cfa_tile = 2 * stride;
+        tiles_x_ = (size_.width + stride - 1) / stride;
+        tiles_y_ = (size_.height + stride - 1) / stride;
+
+        // 升餘弦視窗，間距為半個 tile 時相鄰視窗相加為 1
+        window_.resize(cfa_tile);
+        for (int i = 0; i < cfa_tile; ++i)
+            window_[i] = 0.5f - 0.5f * std::cos(2.0f * static_cast<float>(CV_PI) * (i + 0.5f) / cfa_tile);
+
+        sum_ = cv::Mat::zeros(size_, CV_32FC1);
+        weight_ = cv::Mat::zeros(size_, CV_32FC1);
+
+        std::vector<cv::Point> zero_offsets(tiles_x_ * tiles_y_, cv::Point(0, 0));
+        std::vector<float> unit_weights(tiles_x_ * tiles_y_, 1.0f);
+        Accumulate(reference_raw, zero_offsets, unit_weights);
+        frames_ = 1;
+    }
+
+    bool Merger::Add(const cv::Mat& alternate_raw)
+    {
+        if (alternate_raw.type() != CV_32FC1 || alternate_raw.size() != size_)
+            return false;
+
+        std::vector<cv::Mat> alt_pyramid = BuildPyramid(alternate_raw, static_cast<int>(ref_pyramid_.size()));
+        const int levels = static_cast<int>(std::min(ref_pyramid_.size(), alt_pyramid.size()));
+        const int num_tiles = tiles_x_ * tiles_y_;
+        const int gray_stride = params_.tile_size / 2;
+
+        std::vector<cv::Point> offsets(num_tiles);
+        std::vector<float> weights(num_tiles);
+
+        // 由粗到細對齊：每個 tile 在最粗層大範圍搜尋，往下每層將位移放大兩倍再小範圍修正
+        cv::parallel_for_(cv::Range(0, num_tiles), [&](const cv::Range& range)
+        {
+            for (int t = range.start; t < range.end; ++t)
+            {
+                int tx = t % tiles_x_, ty = t / tiles_x_;
+                int ox = 0, oy = 0;
+                float best = std::numeric_limits<float>::infinity();
+
+                for (int l = levels - 1; l >= 0; --l)
+                {
+                    const cv::Mat& ref = ref_pyramid_[l];
+                    const cv::Mat& alt = alt_pyramid[l];
+                    if (l < levels - 1)
+                    {
+                        ox *= 2;
+                        oy *= 2;
+                    }
+
+                    // 粗層的 tile 至少保留 8 像素，避免只剩一兩個像素而無法比對
+                    int size = std::max(params_.tile_size >> l, 8);
+                    int cx = (tx * gray_stride + params_.tile_size / 2) >> l;
+                    int cy = (ty * gray_stride + params_.tile_size / 2) >> l;
+                    cv::Rect rect = cv::Rect(cx - size / 2, cy - size / 2, size, size) & cv::Rect(0, 0, ref.cols, ref.rows);
+                    if (rect.area() == 0)
+                        continue;
+
+                    int radius = (l == levels - 1) ? params_.search_radius : params_.refine_radius;
+                    int best_x = ox, best_y = oy;
+                    best = TileDistance(ref, alt, rect, ox, oy);
+                    for (int dy = -radius; dy <= radius; ++dy)
+                    {
+                        for (int dx = -radius; dx <= radius; ++dx)
+                        {
+                            if (!dx && !dy)
+                                continue;
+                            float d = TileDistance(ref, alt, rect, ox + dx, oy + dy);
+                            if (d < best)
+                            {
+                                best = d;
+                                best_x = ox + dx;
+                                best_y = oy + dy;
+                            }
+                        }
+                    }
+                    ox = best_x;
+                    oy = best_y;
+                }
+
+                offsets[t] = cv::Point(ox, oy);
+
+                // 對齊後殘差接近雜訊的 tile 全權重合成，殘差越大 (動態物體、對齊失敗) 權重越低
+                float sigma = params_.noise_sigma;
+                if (!std::isfinite(best))
+                    weights[t] = 0.0f;
+                else
+                    weights[t] = (best <= sigma) ? 1.0f : (sigma * sigma) / (best * best);
+            }
+        });
+
+        Accumulate(alternate_raw, offsets, weights);
+        frames_++;
+        return true;
+    }
+
+    void Merger::Accumulate(const cv::Mat& raw, const std::vector<cv::Point>& offsets, const std::vector<float>& weights)
+    {
+        const int stride = params_.tile_size;
+        const int cfa_tile = 2 * stride;
+        const int rows = raw.rows, cols = raw.cols;
+
+        // 相鄰 tile 列會重疊，分奇偶兩輪平行處理，每輪內各 tile 列互不重疊
+        for (int parity = 0; parity < 2; ++parity)
+        {
+            int count = (tiles_y_ - parity + 1) / 2;
+            cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range)
+            {
+                for (int k = range.start; k < range.end; ++k)
+                {
+                    int ty = 2 * k + parity;
+                    int y0 = ty * stride;
+                    int y1 = std::min(y0 + cfa_tile, rows);
+
+                    for (int tx = 0; tx < tiles_x_; ++tx)
+                    {
+                        int t = ty * tiles_x_ + tx;
+                        float w = weights[t];
+                        if (w <= 0.0f)
+                            continue;
+
+                        // 灰階位移換成 CFA 位移 (乘 2) 以保持 Bayer 相位
+                        int dx = 2 * offsets[t].x, dy = 2 * offsets[t].y;
+                        int x0 = tx * stride;
+                        int x1 = std::min(x0 + cfa_tile, cols);
+
+                        for (int y = y0; y < y1; ++y)
+                        {
+                            const float* src = raw.ptr<float>(ClampSamePhase(y + dy, rows, y));
+                            float* sum = sum_.ptr<float>(y);
+                            float* weight = weight_.ptr<float>(y);
+                            float wy = window_[y - y0] * w;
+                            for (int x = x0; x < x1; ++x)
+                            {
+                                float ww = wy * window_[x - x0];
+                                sum[x] += ww * src[ClampSamePhase(x + dx, cols, x)];
+                                weight[x] += ww;
+                            }
+                        }
+                    }
+                }
+            });
+        }
+    }
+
+    cv::Mat Merger::Result() const
+    {
+        cv::Mat merged;
+        cv::divide(sum_, weight_, merged);
+        return merged;
+    }
+}
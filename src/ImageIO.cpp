@@ -1,6 +1,9 @@
 #include "Utils.hpp"
+#include "ImageIO.hpp"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <vector>
 #include <libraw/libraw.h>
 
 namespace ImageIO
@@ -26,7 +29,7 @@ namespace ImageIO
         return rawImg;
     }
 
-    cv::Mat ReadDNG(LibRaw& processor)
+    cv::Mat ReadDNG(LibRaw& processor, Statistics::Collector* collector)
     {
         int width = processor.imgdata.sizes.raw_width;
         int height = processor.imgdata.sizes.raw_height;
@@ -44,20 +47,75 @@ namespace ImageIO
             max_val = 65535; 
         }
 
+        // RAW 未扣除黑位，把各通道黑位 (black + cblack[R/G/B]) 正規化後交給統計判斷暗部裁切
+        if (collector)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                float black = static_cast<float>(processor.imgdata.color.black + processor.imgdata.color.cblack[c]);
+                collector->SetBlackLevel(c, black / max_val);
+            }
+        }
+
+        // 線性 DNG 或非 CFA 格式時 LibRaw 不會填 raw_image
+        const ushort* raw_pixels = processor.imgdata.rawdata.raw_image;
+        if (!raw_pixels)
+        {
+            std::cerr << "Error: No Bayer CFA data in raw file (linear or non-CFA DNG)." << std::endl;
+            return cv::Mat();
+        }
+
         cv::Mat raw_image(height, width, CV_32FC1); // 創建浮點單通道 Mat
+        const float scale = 1.0f / max_val;
 
-        // 遍歷 RAW 數據，並進行正規化
-        for (int i = 0; i < height; ++i)
+        // 依列切成偶數高度的區段平行正規化，每個區段各自累積統計，最後依序合併
+        const int band_rows = std::max(2, ((height / std::max(cv::getNumThreads() * 4, 1)) + 1) & ~1);
+        const int num_bands = (height + band_rows - 1) / band_rows;
+        std::vector<Statistics::Collector> band_stats;
+        if (collector)
+            band_stats.assign(num_bands, collector->EmptyCopy());
+
+        cv::parallel_for_(cv::Range(0, num_bands), [&](const cv::Range& range)
         {
-            for (int j = 0; j < width; ++j)
+            for (int b = range.start; b < range.end; ++b)
             {
-                // 從 LibRaw 獲取原始像素值
-                ushort pixel_value = processor.imgdata.rawdata.raw_image[i * width + j];
-                
-                // 將 ushort 值轉換為 float，並除以 max_val 進行正規化
-                raw_image.at<float>(i, j) = static_cast<float>(pixel_value) / max_val;
+                int row_begin = b * band_rows;
+                int row_end = std::min(row_begin + band_rows, height);
+                std::vector<float> above_scratch;
+                for (int i = row_begin; i < row_end; ++i)
+                {
+                    // 從 LibRaw 獲取原始像素值，轉成 float 並正規化
+                    const ushort* src = raw_pixels + static_cast<size_t>(i) * width;
+                    float* row = raw_image.ptr<float>(i);
+                    for (int j = 0; j < width; ++j)
+                        row[j] = static_cast<float>(src[j]) * scale;
+
+                    // 趁這一列還在 cache 裡順便累積統計
+                    if (collector && band_stats[b].IsSampledRow(i))
+                    {
+                        // 上方同色列在區段內就直接用已寫好的結果，否則從 LibRaw 緩衝區重新正規化一列，
+                        // 讓每個 i >= 2 的列都有垂直梯度，統計結果與區段切法 (核心數) 無關
+                        const float* above = nullptr;
+                        if (i - 2 >= row_begin)
+                        {
+                            above = raw_image.ptr<float>(i - 2);
+                        }
+                        else if (i >= 2)
+                        {
+                            const ushort* above_src = raw_pixels + static_cast<size_t>(i - 2) * width;
+                            above_scratch.resize(width);
+                            for (int j = 0; j < width; ++j)
+                                above_scratch[j] = static_cast<float>(above_src[j]) * scale;
+                            above = above_scratch.data();
+                        }
+                        band_stats[b].AccumulateRow(i, row, above, width);
+                    }
+                }
             }
-        }
+        });
+
+        for (const auto& band : band_stats)
+            collector->Merge(band);
         return raw_image;
     }
 
@@ -110,22 +168,31 @@ namespace ImageIO
         cv::destroyWindow(winName); 
     }
 
-    void SaveImage(const std::string& filepath, const cv::Mat& img)
+    bool SaveImage(const std::string& filepath, const cv::Mat& img)
     {
         if (img.empty()) {
             std::cerr << "Error: Attempted to save empty image to: " << filepath << std::endl;
-            return;
+            return false;
         }
 
         // --- 移除重複的轉換邏輯 ---
         // 傳入 img 應該已經是 CV_8U 類型 (0-255 範圍)
-        // 直接使用 img 進行保存
-        bool success = cv::imwrite(filepath, img); 
+        // 直接使用 img 進行保存；不支援的副檔名會丟 cv::Exception，一併視為失敗
+        bool success = false;
+        try
+        {
+            success = cv::imwrite(filepath, img);
+        }
+        catch (const cv::Exception& e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
         // ---------------------------
         
         if (!success) {
             std::cerr << "Error: Could not save image to " << filepath << std::endl;
         }
+        return success;
     }
 
 }
@@ -0,0 +1,243 @@
+#include "Pipeline.hpp"
+#include "Utils.hpp"
+#include "ImageIO.hpp"
+#include "Demosaic.hpp"
+#include "Burst.hpp"
+#include <chrono>
+#include <future>
+#include <sstream>
+
+namespace Pipeline
+{
+    using Clock = std::chrono::steady_clock;
+
+    static double ElapsedMs(Clock::time_point& start)
+    {
+        Clock::time_point now = Clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - start).count();
+        start = now;
+        return ms;
+    }
+
+    bool Worker::Decode(LibRaw& processor, const std::string& path, std::string& error)
+    {
+        // 重用同一個 LibRaw 實例，只釋放上一張影像的資料
+        processor.recycle();
+        if (processor.open_file(path.c_str()) != LIBRAW_SUCCESS)
+        {
+            error = "Failed to open DNG file: " + path;
+            return false;
+        }
+        if (processor.unpack() != LIBRAW_SUCCESS)
+        {
+            error = "Failed to unpack DNG file: " + path;
+            return false;
+        }
+        if (!processor.imgdata.rawdata.raw_image)
+        {
+            error = "No Bayer CFA data (linear or non-CFA DNG unsupported): " + path;
+            return false;
+        }
+        return true;
+    }
+
+    bool Worker::LoadFrame(LibRaw& processor, const std::string& path, cv::Mat& frame, std::string& error)
+    {
+        if (!Decode(processor, path, error))
+            return false;
+        frame = ImageIO::ReadDNG(processor);
+        // 影格已複製成 float Mat，釋放 LibRaw 解碼緩衝區，避免常駐 worker 一直佔著
+        processor.recycle();
+        if (frame.empty())
+        {
+            error = "Raw image data is empty: " + path;
+            return false;
+        }
+        return true;
+    }
+
+    void Worker::PrepareMasks(int height, int width, const std::string& pattern)
+    {
+        if (maskR_.rows == height && maskR_.cols == width && mask_pattern_ == pattern)
+            return;
+
+        std::string p = pattern;
+        Utils::GenerateBayerMasks(height, width, maskR_, maskG_, maskB_, p);
+        mask_pattern_ = pattern;
+    }
+
+    const std::vector<float>& Worker::GammaLUT(double gamma)
+    {
+        if (gamma_lut_.empty() || lut_gamma_ != gamma)
+        {
+            gamma_lut_ = Utils::BuildGammaLUT(gamma);
+            lut_gamma_ = gamma;
+        }
+        return gamma_lut_;
+    }
+
+    cv::Mat Worker::Develop(const cv::Mat& raw, const std::string& pattern, const float cam_mul[4],
+                            const cv::Mat& ccm, double gamma, Timing& timing)
+    {
+        Clock::time_point t = Clock::now();
+
+        PrepareMasks(raw.rows, raw.cols, pattern);
+        auto init_bgr = Utils::AssignInitialChannels(raw, maskR_, maskG_, maskB_);
+        if (interactive_)
+        {
+            cv::Mat init_bgr_display;
+            init_bgr.convertTo(init_bgr_display, CV_8UC3, 255.0);
+            ImageIO::ShowImage("Initial BGR Channels", init_bgr_display);
+            t = Clock::now(); // 等待視窗的時間不算進解馬賽克
+        }
+        auto demosaiced = Demosaic::NearestNeighborInterpolation(init_bgr);
+        timing.demosaic_ms += ElapsedMs(t);
+
+        auto white_balanced = Utils::ApplyWhiteBalance(demosaiced, cam_mul);
+        auto color_corrected = Utils::ApplyCCM(white_balanced, ccm);
+        timing.color_ms += ElapsedMs(t);
+
+        cv::Mat gamma_corrected = interactive_ ? Utils::ApplyGammaCorrection(color_corrected, gamma)
+                                               : Utils::ApplyGammaLUT(color_corrected, GammaLUT(gamma));
+        cv::Mat image_display;
+        gamma_corrected.convertTo(image_display, CV_8UC3, 255.0);
+        timing.gamma_ms += ElapsedMs(t);
+
+        return image_display;
+    }
+
+    bool Worker::Run(const Job& job, Timing& timing, std::string& error, Output* output)
+    {
+        Clock::time_point start = Clock::now();
+        Clock::time_point t = start;
+        timing = Timing();
+
+        if (!Decode(processor_, job.input_path, error))
+            return false;
+        timing.decode_ms = ElapsedMs(t);
+
+        // 連拍的第一張影格在背景解碼，與參考影格的讀取重疊進行
+        cv::Mat frames[2];
+        std::string frame_error;
+        auto prefetch = [&](size_t k)
+        {
+            return std::async(std::launch::async, [this, &job, &frames, &frame_error, k]()
+            {
+                return LoadFrame(prefetch_processor_, job.burst_paths[k], frames[k % 2], frame_error);
+            });
+        };
+        std::future<bool> pending;
+        if (!job.burst_paths.empty())
+            pending = prefetch(0);
+
+        std::string pattern = job.pattern.empty() ? Utils::GetBayerPattern(processor_) : job.pattern;
+        if (pattern == "UNKNOWN")
+        {
+            error = "Failed to determine Bayer Pattern.";
+            return false;
+        }
+        if (!job.pattern.empty() && pattern != "RGGB")
+        {
+            error = pattern + " pattern Unsupported now.";
+            return false;
+        }
+
+        cv::Mat ccm_mat(3, 3, CV_32F);
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                ccm_mat.at<float>(i, j) = processor_.imgdata.color.rgb_cam[i][j];
+
+        float cam_mul_coeffs[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            cam_mul_coeffs[i] = processor_.imgdata.color.cam_mul[i];
+            if (cam_mul_coeffs[i] <= 0) cam_mul_coeffs[i] = 1.0f;
+        }
+
+        // 只有要求輸出統計時才在讀取時累積
+        const bool want_stats = !job.stats_path.empty() || output;
+        Statistics::Collector collector(pattern, job.stats_step);
+        cv::Mat raw = ImageIO::ReadDNG(processor_, want_stats ? &collector : nullptr);
+        processor_.recycle(); // CCM / cam_mul 已取出，參考影格的解碼緩衝區也不再需要
+        if (raw.empty())
+        {
+            error = "Raw image data is empty.";
+            return false;
+        }
+        if (want_stats)
+        {
+            Statistics::ImageStats stats = collector.Finish(raw.cols, raw.rows);
+            stats.source = job.input_path;
+            if (!job.stats_path.empty() && !Statistics::SaveJson(job.stats_path, stats))
+            {
+                error = "Failed to write stats file: " + job.stats_path;
+                return false;
+            }
+            if (output)
+                output->stats = stats;
+        }
+        timing.ingest_ms = ElapsedMs(t);
+
+        // 連拍模式：其餘影格逐張讀入並對齊到參考影格，合成後再進入後段流程
+        if (!job.burst_paths.empty())
+        {
+            Burst::Merger merger(raw);
+            for (size_t k = 0; k < job.burst_paths.size(); ++k)
+            {
+                // 只記錄等待背景解碼完成的時間；get() 回來後 prefetch_processor_ 已 recycle，可以解碼下一張
+                bool loaded = pending.get();
+                timing.decode_ms += ElapsedMs(t);
+                if (!loaded)
+                {
+                    error = frame_error;
+                    return false;
+                }
+                if (k + 1 < job.burst_paths.size())
+                    pending = prefetch(k + 1);
+
+                if (!merger.Add(frames[k % 2]))
+                {
+                    error = "Burst frame size mismatch: " + job.burst_paths[k];
+                    return false;
+                }
+                frames[k % 2].release();
+                timing.merge_ms += ElapsedMs(t);
+            }
+            raw = merger.Result();
+            timing.merge_ms += ElapsedMs(t);
+        }
+
+        cv::Mat image_display = Develop(raw, pattern, cam_mul_coeffs, ccm_mat, job.gamma_value, timing);
+        t = Clock::now();
+
+        if (!job.output_path.empty() && !ImageIO::SaveImage(job.output_path, image_display))
+        {
+            error = "Failed to write output image: " + job.output_path;
+            return false;
+        }
+        timing.save_ms = ElapsedMs(t);
+
+        if (output)
+        {
+            output->image = image_display;
+            output->pattern = pattern;
+        }
+
+        timing.total_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        return true;
+    }
+
+    std::string TimingToJson(const Timing& timing)
+    {
+        std::ostringstream os;
+        os << "{\"decode\": " << timing.decode_ms
+           << ", \"ingest\": " << timing.ingest_ms
+           << ", \"merge\": " << timing.merge_ms
+           << ", \"demosaic\": " << timing.demosaic_ms
+           << ", \"color\": " << timing.color_ms
+           << ", \"gamma\": " << timing.gamma_ms
+           << ", \"save\": " << timing.save_ms
+           << ", \"total\": " << timing.total_ms << "}";
+        return os.str();
+    }
+}
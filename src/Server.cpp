@@ -0,0 +1,436 @@
+#include "Server.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Server
+{
+    // 一個客戶端連線；所有屬於它的工作都處理完後才關閉
+    struct Connection
+    {
+        int in_fd;
+        int out_fd;
+        bool owns_fd;
+        std::mutex write_mutex;
+        std::atomic<bool> reading{true}; // 讀取執行緒結束後設為 false，主迴圈據此回收執行緒
+
+        Connection(int in, int out, bool owns) : in_fd(in), out_fd(out), owns_fd(owns) {}
+        ~Connection()
+        {
+            if (owns_fd)
+                close(in_fd);
+        }
+
+        void Reply(const std::string& line)
+        {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            std::string msg = line + "\n";
+            size_t sent = 0;
+            while (sent < msg.size())
+            {
+                ssize_t n = write(out_fd, msg.data() + sent, msg.size() - sent);
+                if (n <= 0)
+                    return; // 客戶端已離線
+                sent += static_cast<size_t>(n);
+            }
+        }
+    };
+
+    struct Task
+    {
+        Pipeline::Job job;
+        std::shared_ptr<Connection> conn;
+    };
+
+    class TaskQueue
+    {
+    public:
+        // 佇列關閉後不再接受工作，由呼叫端回覆錯誤，避免工作被默默丟掉
+        bool Push(Task task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (closed_)
+                    return false;
+                tasks_.push_back(std::move(task));
+            }
+            cv_.notify_one();
+            return true;
+        }
+
+        bool Pop(Task& task)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return closed_ || !tasks_.empty(); });
+            if (tasks_.empty())
+                return false;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+            return true;
+        }
+
+        void Close()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+            }
+            cv_.notify_all();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<Task> tasks_;
+        bool closed_ = false;
+    };
+
+    static std::string ErrorJson(const std::string& id, const std::string& message)
+    {
+        return "{\"id\": \"" + Utils::EscapeJson(id) + "\", \"status\": \"error\", \"message\": \"" + Utils::EscapeJson(message) + "\"}";
+    }
+
+    bool ParseJob(const std::string& line, Pipeline::Job& job, std::string& error)
+    {
+        std::istringstream is(line);
+        std::string token;
+        while (is >> token)
+        {
+            size_t eq = token.find('=');
+            if (eq == std::string::npos)
+            {
+                error = "Malformed token (expected key=value): " + token;
+                return false;
+            }
+            std::string key = token.substr(0, eq);
+            std::string value = token.substr(eq + 1);
+
+            try
+            {
+                if (key == "id")              job.id = value;
+                else if (key == "input")      job.input_path = value;
+                else if (key == "output")     job.output_path = value;
+                else if (key == "pattern")    job.pattern = value;
+                else if (key == "gamma")      job.gamma_value = std::stod(value);
+                else if (key == "stats")      job.stats_path = value;
+                else if (key == "stats_step") job.stats_step = std::max(std::stoi(value), 1);
+                else if (key == "burst")
+                {
+                    std::istringstream frames(value);
+                    std::string path;
+                    while (std::getline(frames, path, ','))
+                        if (!path.empty())
+                            job.burst_paths.push_back(path);
+                }
+                else
+                {
+                    error = "Unknown key: " + key;
+                    return false;
+                }
+            }
+            catch (const std::exception&)
+            {
+                error = "Invalid value for " + key + ": " + value;
+                return false;
+            }
+        }
+
+        if (job.input_path.empty())
+        {
+            error = "Missing input=<file.dng>";
+            return false;
+        }
+        if (job.gamma_value <= 0.0)
+        {
+            error = "gamma must be positive";
+            return false;
+        }
+        return true;
+    }
+
+    static void WorkerLoop(TaskQueue& queue)
+    {
+        Pipeline::Worker worker; // 每個執行緒持有自己的 LibRaw 與查表，工作之間保持暖機
+
+        Task task;
+        while (queue.Pop(task))
+        {
+            Pipeline::Timing timing;
+            std::string error;
+            bool ok = false;
+            // 單一工作的例外 (cv::Exception、bad_alloc 等) 只回報錯誤，不能讓常駐程序結束
+            try
+            {
+                ok = worker.Run(task.job, timing, error);
+            }
+            catch (const std::exception& e)
+            {
+                error = std::string("Exception: ") + e.what();
+            }
+
+            if (ok)
+            {
+                std::ostringstream os;
+                os << "{\"id\": \"" << Utils::EscapeJson(task.job.id) << "\", \"status\": \"ok\""
+                   << ", \"input\": \"" << Utils::EscapeJson(task.job.input_path) << "\""
+                   << ", \"output\": \"" << Utils::EscapeJson(task.job.output_path) << "\""
+                   << ", \"timing_ms\": " << Pipeline::TimingToJson(timing) << "}";
+                task.conn->Reply(os.str());
+            }
+            else
+            {
+                task.conn->Reply(ErrorJson(task.job.id, error));
+            }
+            task = Task(); // 釋放連線參考
+        }
+    }
+
+    static void HandleLine(std::string line, const std::shared_ptr<Connection>& conn, TaskQueue& queue)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            return;
+
+        Pipeline::Job job;
+        std::string error;
+        if (!ParseJob(line, job, error))
+            conn->Reply(ErrorJson(job.id, error));
+        else if (!queue.Push(Task{job, conn}))
+            conn->Reply(ErrorJson(job.id, "Server is shutting down"));
+    }
+
+    // 逐行讀取工作並放入佇列，直到對方關閉輸入
+    static void ReadJobs(std::shared_ptr<Connection> conn, TaskQueue& queue)
+    {
+        std::string pending;
+        char buffer[4096];
+        while (true)
+        {
+            ssize_t n = read(conn->in_fd, buffer, sizeof(buffer));
+            if (n <= 0)
+                break;
+            pending.append(buffer, static_cast<size_t>(n));
+
+            size_t pos;
+            while ((pos = pending.find('\n')) != std::string::npos)
+            {
+                HandleLine(pending.substr(0, pos), conn, queue);
+                pending.erase(0, pos + 1);
+            }
+        }
+
+        // 最後一行沒有換行結尾時也要處理
+        HandleLine(pending, conn, queue);
+        conn->reading = false;
+    }
+
+    // SIGINT / SIGTERM 只往 pipe 寫一個位元組，由主迴圈的 poll() 收到後正常收尾
+    static int g_signal_pipe[2] = {-1, -1};
+
+    static void OnSignal(int)
+    {
+        int saved_errno = errno;
+        ssize_t n = write(g_signal_pipe[1], "x", 1);
+        (void)n;
+        errno = saved_errno;
+    }
+
+    static void StopWorkers(TaskQueue& queue, std::vector<std::thread>& workers)
+    {
+        queue.Close(); // 已排入的工作仍會處理完並回覆
+        for (auto& w : workers)
+            w.join();
+    }
+
+    // 建立只有擁有者可存取的 listening socket；路徑已存在且不是 socket 時拒絕覆蓋
+    static int Listen(const std::string& socket_path)
+    {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(addr.sun_path))
+        {
+            std::cerr << "Error: Socket path too long: " << socket_path << std::endl;
+            return -1;
+        }
+        std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+        struct stat st;
+        if (lstat(socket_path.c_str(), &st) == 0)
+        {
+            if (!S_ISSOCK(st.st_mode))
+            {
+                std::cerr << "Error: " << socket_path << " exists and is not a socket" << std::endl;
+                return -1;
+            }
+            unlink(socket_path.c_str()); // 上次執行留下的 socket
+        }
+        else if (errno != ENOENT)
+        {
+            std::cerr << "Error: Cannot stat " << socket_path << ": " << std::strerror(errno) << std::endl;
+            return -1;
+        }
+
+        int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0)
+        {
+            std::cerr << "Error: Failed to create socket: " << std::strerror(errno) << std::endl;
+            return -1;
+        }
+
+        mode_t old_mask = umask(0077); // socket 檔權限為 0600，其他使用者無法送工作進來
+        int bound = bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        umask(old_mask);
+        if (bound < 0 || listen(listen_fd, 16) < 0)
+        {
+            std::cerr << "Error: Failed to listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+            close(listen_fd);
+            if (bound == 0)
+                unlink(socket_path.c_str());
+            return -1;
+        }
+        return listen_fd;
+    }
+
+    int Run(const std::string& socket_path, int num_workers)
+    {
+        if (num_workers <= 0)
+            num_workers = std::max(1u, std::thread::hardware_concurrency());
+
+        // 客戶端中途離線時不要讓整個常駐程序被 SIGPIPE 終止
+        std::signal(SIGPIPE, SIG_IGN);
+
+        TaskQueue queue;
+        std::vector<std::thread> workers;
+        for (int i = 0; i < num_workers; ++i)
+            workers.emplace_back(WorkerLoop, std::ref(queue));
+
+        if (socket_path == "-")
+        {
+            // stdout 保留給回應；處理過程中的訊息改送到 stderr
+            int reply_fd = dup(STDOUT_FILENO);
+            std::cout.flush();
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+
+            std::cerr << "mini_isp serving on stdin/stdout with " << num_workers << " workers" << std::endl;
+            ReadJobs(std::make_shared<Connection>(STDIN_FILENO, reply_fd, false), queue);
+
+            queue.Close();
+            for (auto& w : workers)
+                w.join();
+            close(reply_fd);
+            return 0;
+        }
+
+        int listen_fd = Listen(socket_path);
+        if (listen_fd < 0 || pipe(g_signal_pipe) < 0)
+        {
+            if (listen_fd >= 0)
+            {
+                close(listen_fd);
+                unlink(socket_path.c_str());
+            }
+            StopWorkers(queue, workers);
+            return -1;
+        }
+        fcntl(g_signal_pipe[1], F_SETFL, O_NONBLOCK);
+        fcntl(listen_fd, F_SETFL, O_NONBLOCK); // poll() 回報可讀後客戶端仍可能已放棄連線
+
+        struct sigaction action, old_int, old_term;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = OnSignal;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, &old_int);
+        sigaction(SIGTERM, &action, &old_term);
+
+        std::cout << "mini_isp serving on " << socket_path << " with " << num_workers << " workers" << std::endl;
+
+        // 讀取執行緒一律由這裡 join，佇列與連線都不會比它們先結束
+        struct Reader
+        {
+            std::shared_ptr<Connection> conn;
+            std::thread thread;
+        };
+        std::vector<Reader> readers;
+        int status = 0;
+
+        while (true)
+        {
+            pollfd fds[2] = {{listen_fd, POLLIN, 0}, {g_signal_pipe[0], POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                std::cerr << "Error: poll failed: " << std::strerror(errno) << std::endl;
+                status = -1;
+                break;
+            }
+            if (fds[1].revents)
+            {
+                std::cerr << "mini_isp shutting down" << std::endl;
+                break;
+            }
+
+            // 回收已經讀完的連線
+            for (auto it = readers.begin(); it != readers.end();)
+            {
+                if (it->conn->reading)
+                {
+                    ++it;
+                    continue;
+                }
+                it->thread.join();
+                it = readers.erase(it);
+            }
+
+            int client_fd = accept(listen_fd, nullptr, nullptr);
+            if (client_fd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN || errno == EWOULDBLOCK)
+                    continue;
+                std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+                status = -1;
+                break;
+            }
+
+            auto conn = std::make_shared<Connection>(client_fd, client_fd, true);
+            readers.push_back(Reader{conn, std::thread(ReadJobs, conn, std::ref(queue))});
+        }
+
+        close(listen_fd);
+        unlink(socket_path.c_str());
+        sigaction(SIGINT, &old_int, nullptr);
+        sigaction(SIGTERM, &old_term, nullptr);
+
+        // 停止讀取新工作，但保留寫入端讓已排入的工作還能回覆
+        for (auto& reader : readers)
+        {
+            shutdown(reader.conn->in_fd, SHUT_RD);
+            reader.thread.join();
+        }
+        StopWorkers(queue, workers);
+
+        close(g_signal_pipe[0]);
+        close(g_signal_pipe[1]);
+        g_signal_pipe[0] = g_signal_pipe[1] = -1;
+        return status;
+    }
+}
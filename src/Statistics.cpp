@@ -0,0 +1,194 @@
+#include "Statistics.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace Statistics
+{
+    float ImageStats::Min() const
+    {
+        float value = 1.0f;
+        for (const auto& ch : channels)
+            if (ch.count) value = std::min(value, ch.min);
+        return value;
+    }
+
+    float ImageStats::Max() const
+    {
+        float value = 0.0f;
+        for (const auto& ch : channels)
+            if (ch.count) value = std::max(value, ch.max);
+        return value;
+    }
+
+    double ImageStats::MeanLuma() const
+    {
+        return 0.299 * channels[0].Mean() + 0.587 * channels[1].Mean() + 0.114 * channels[2].Mean();
+    }
+
+    Collector::Collector(const std::string& pattern, int step, int bins)
+        : step_(std::max(step, 1)), bins_(std::max(bins, 2))
+    {
+        // pattern 的四個字元依序對應 (0,0) (0,1) (1,0) (1,1)
+        for (int k = 0; k < 4; ++k)
+        {
+            char c = (k < static_cast<int>(pattern.size())) ? pattern[k] : '?';
+            if (c == 'R')      channel_of_[k] = 0;
+            else if (c == 'G') channel_of_[k] = 1;
+            else if (c == 'B') channel_of_[k] = 2;
+            else               channel_of_[k] = -1;
+        }
+
+        stats_.pattern = pattern;
+        stats_.step = step_;
+        for (auto& ch : stats_.channels)
+            ch.histogram.assign(bins_, 0);
+    }
+
+    Collector Collector::EmptyCopy() const
+    {
+        Collector copy(stats_.pattern, step_, bins_);
+        for (int c = 0; c < 3; ++c)
+            copy.SetBlackLevel(c, stats_.channels[c].black_level);
+        return copy;
+    }
+
+    void Collector::AccumulateRow(int row, const float* data, const float* row_above, int width)
+    {
+        if (!IsSampledRow(row))
+            return;
+
+        const int stride = step_ * 2;
+        double grad_sum = 0.0;
+        uint64_t grad_count = 0;
+
+        for (int quad = 0; quad < width; quad += stride)
+        {
+            for (int j = quad; j < quad + 2 && j < width; ++j)
+            {
+                int ch = ChannelAt(row, j);
+                if (ch < 0)
+                    continue;
+
+                float v = data[j];
+                ChannelStats& cs = stats_.channels[ch];
+
+                int bin = static_cast<int>(v * bins_);
+                bin = std::min(std::max(bin, 0), bins_ - 1);
+                cs.histogram[bin]++;
+                cs.count++;
+                cs.sum += v;
+                if (v >= 1.0f) cs.clipped_high++;
+                if (v <= cs.black_level) cs.clipped_low++;
+                if (v < cs.min) cs.min = v;
+                if (v > cs.max) cs.max = v;
+
+                // 同色像素在 CFA 上相隔 2，直接用已讀入的左方與上方像素計算梯度
+                if (j >= 2 && row_above)
+                {
+                    float gx = v - data[j - 2];
+                    float gy = v - row_above[j];
+                    grad_sum += gx * gx + gy * gy;
+                    grad_count++;
+                }
+            }
+        }
+
+        stats_.sharpness += grad_sum;
+        stats_.sharpness_samples += grad_count;
+    }
+
+    void Collector::Merge(const Collector& other)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            ChannelStats& dst = stats_.channels[c];
+            const ChannelStats& src = other.stats_.channels[c];
+            for (int b = 0; b < bins_ && b < static_cast<int>(src.histogram.size()); ++b)
+                dst.histogram[b] += src.histogram[b];
+            dst.count += src.count;
+            dst.clipped_high += src.clipped_high;
+            dst.clipped_low += src.clipped_low;
+            dst.sum += src.sum;
+            dst.min = std::min(dst.min, src.min);
+            dst.max = std::max(dst.max, src.max);
+        }
+        stats_.sharpness += other.stats_.sharpness;
+        stats_.sharpness_samples += other.stats_.sharpness_samples;
+    }
+
+    ImageStats Collector::Finish(int width, int height) const
+    {
+        ImageStats result = stats_;
+        result.width = width;
+        result.height = height;
+        // 累積時存的是梯度平方和，輸出前換成平均值
+        result.sharpness = result.sharpness_samples ? result.sharpness / result.sharpness_samples : 0.0;
+        return result;
+    }
+
+    ImageStats Compute(const cv::Mat& raw, const std::string& pattern, int step)
+    {
+        CV_Assert(raw.type() == CV_32FC1);
+
+        Collector collector(pattern, step);
+        for (int i = 0; i < raw.rows; ++i)
+        {
+            const float* above = (i >= 2) ? raw.ptr<float>(i - 2) : nullptr;
+            collector.AccumulateRow(i, raw.ptr<float>(i), above, raw.cols);
+        }
+        return collector.Finish(raw.cols, raw.rows);
+    }
+
+    std::string ToJson(const ImageStats& stats)
+    {
+        static const char* names[3] = {"R", "G", "B"};
+
+        std::ostringstream os;
+        os << "{\n";
+        os << "  \"source\": \"" << Utils::EscapeJson(stats.source) << "\",\n";
+        os << "  \"pattern\": \"" << Utils::EscapeJson(stats.pattern) << "\",\n";
+        os << "  \"width\": " << stats.width << ",\n";
+        os << "  \"height\": " << stats.height << ",\n";
+        os << "  \"step\": " << stats.step << ",\n";
+        os << "  \"min\": " << stats.Min() << ",\n";
+        os << "  \"max\": " << stats.Max() << ",\n";
+        os << "  \"mean_luma\": " << stats.MeanLuma() << ",\n";
+        os << "  \"sharpness\": " << stats.sharpness << ",\n";
+        os << "  \"channels\": {\n";
+        for (int c = 0; c < 3; ++c)
+        {
+            const ChannelStats& ch = stats.channels[c];
+            os << "    \"" << names[c] << "\": {\n";
+            os << "      \"count\": " << ch.count << ",\n";
+            os << "      \"mean\": " << ch.Mean() << ",\n";
+            os << "      \"min\": " << (ch.count ? ch.min : 0.0f) << ",\n";
+            os << "      \"max\": " << ch.max << ",\n";
+            os << "      \"clipped_high\": " << ch.clipped_high << ",\n";
+            os << "      \"clipped_low\": " << ch.clipped_low << ",\n";
+            os << "      \"black_level\": " << ch.black_level << ",\n";
+            os << "      \"histogram\": [";
+            for (size_t b = 0; b < ch.histogram.size(); ++b)
+                os << (b ? ", " : "") << ch.histogram[b];
+            os << "]\n";
+            os << "    }" << (c < 2 ? "," : "") << "\n";
+        }
+        os << "  }\n";
+        os << "}\n";
+        return os.str();
+    }
+
+    bool SaveJson(const std::string& filepath, const ImageStats& stats)
+    {
+        std::ofstream file(filepath);
+        if (!file)
+        {
+            std::cerr << "Error: Could not open stats file: " << filepath << std::endl;
+            return false;
+        }
+        file << ToJson(stats);
+        return static_cast<bool>(file);
+    }
+}
@@ -234,6 +234,67 @@ namespace Utils
     }
 
 
+    std::vector<float> BuildGammaLUT(double gamma, int size)
+    {
+        std::vector<float> lut(size);
+        for (int i = 0; i < size; ++i)
+        {
+            double v = std::pow(static_cast<double>(i) / (size - 1), 1.0 / gamma);
+            lut[i] = static_cast<float>(std::min(std::max(v, 0.0), 1.0));
+        }
+        return lut;
+    }
+
+    cv::Mat ApplyGammaLUT(const cv::Mat& input_bgr, const std::vector<float>& lut)
+    {
+        if (input_bgr.channels() != 3 || input_bgr.depth() != CV_32F || lut.size() < 2)
+        {
+            std::cerr << "Error: ApplyGammaLUT expects 3-channel CV_32F input and a valid LUT." << std::endl;
+            return input_bgr.clone();
+        }
+
+        cv::Mat output_bgr(input_bgr.size(), CV_32FC3);
+        const float scale = static_cast<float>(lut.size() - 1);
+        const int last = static_cast<int>(lut.size()) - 1;
+
+        for (int i = 0; i < input_bgr.rows; ++i)
+        {
+            const float* src = input_bgr.ptr<float>(i);
+            float* dst = output_bgr.ptr<float>(i);
+            for (int j = 0; j < input_bgr.cols * 3; ++j)
+            {
+                int idx = static_cast<int>(src[j] * scale + 0.5f);
+                dst[j] = lut[std::min(std::max(idx, 0), last)];
+            }
+        }
+        return output_bgr;
+    }
+
+
+    std::string EscapeJson(const std::string& text)
+    {
+        // 路徑、工作 id 與例外訊息 (例如 cv::Exception 結尾的換行) 都可能帶控制字元
+        static const char hex[] = "0123456789abcdef";
+        std::string out;
+        for (char c : text)
+        {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') { out += '\\'; out += c; }
+            else if (c == '\n') out += "\\n";
+            else if (c == '\r') out += "\\r";
+            else if (c == '\t') out += "\\t";
+            else if (u < 0x20)
+            {
+                out += "\\u00";
+                out += hex[u >> 4];
+                out += hex[u & 0x0f];
+            }
+            else out += c;
+        }
+        return out;
+    }
+
+
     void ShowImage(const std::string& winName, const cv::Mat& img)
     {
         cv::Mat disp_8u;